@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+#include "../../concurrent/include/append_only.hpp"
+#include "../../concurrent/include/vector.hpp"
+#include "../../sequential/include/vector.hpp"
+#ifdef WITH_MRLOCK
+#include "../../mrlock/include/vector.hpp"
+#endif
+
+// Gives the vectors one interface for the benchmark. Every call takes
+// the calling thread's id, which only the wait-free vectors use. Operations
+// throw or fail exactly where the wrapped vector does; those that change the
+// vector return whether they did.
+namespace bench {
+
+  template <typename Vector>
+  struct adapter;
+
+  template <typename T, typename Reclaimer, typename Growth, typename Storage,
+            std::size_t MaxThreads>
+  struct adapter<waitfree::vector<T, Reclaimer, Growth, Storage, MaxThreads>> {
+    static const bool thread_safe = true;
+    static const bool has_write = true;
+
+    waitfree::vector<T, Reclaimer, Growth, Storage, MaxThreads> vec;
+
+    adapter(const std::size_t num_threads) : vec(num_threads) {
+    }
+
+    bool push_back(const std::size_t tid, T* const x) {
+      this->vec.wf_push_back(tid, x);
+      return true;
+    }
+
+    bool pop_back(const std::size_t tid) {
+      return this->vec.wf_popback(tid).first;
+    }
+
+    T* at(const std::size_t tid, const std::size_t pos) {
+      return this->vec.at(tid, pos).second;
+    }
+
+    // a cwrite over whatever is there
+    bool write(const std::size_t tid, const std::size_t pos, T* const x) {
+      return this->vec.cwrite(tid, pos, this->at(tid, pos), x).first;
+    }
+
+    bool insert(const std::size_t tid, const std::size_t pos, T* const x) {
+      return this->vec.insertAt(tid, pos, x);
+    }
+
+    bool erase(const std::size_t tid, const std::size_t pos) {
+      return this->vec.eraseAt(tid, pos);
+    }
+
+    std::size_t size(void) {
+      return this->vec.size();
+    }
+  };
+
+  // Only pushes and reads; everything else throws, which the benchmark
+  // counts as a failed op.
+  template <typename T, typename Reclaimer, typename Growth>
+  struct adapter<waitfree::append_only_vector<T, Reclaimer, Growth>> {
+    static const bool thread_safe = true;
+    static const bool has_write = false;
+
+    waitfree::append_only_vector<T, Reclaimer, Growth> vec;
+
+    adapter(const std::size_t num_threads) : vec(num_threads) {
+    }
+
+    bool push_back(const std::size_t tid, T* const x) {
+      this->vec.push_back(tid, x);
+      return true;
+    }
+
+    bool pop_back(const std::size_t) {
+      throw std::logic_error{"pop_back is not supported"};
+    }
+
+    T* at(const std::size_t tid, const std::size_t pos) {
+      return this->vec.at(tid, pos).second;
+    }
+
+    bool write(const std::size_t, const std::size_t, T* const) {
+      throw std::logic_error{"write is not supported"};
+    }
+
+    bool insert(const std::size_t, const std::size_t, T* const) {
+      throw std::logic_error{"insert is not supported"};
+    }
+
+    bool erase(const std::size_t, const std::size_t) {
+      throw std::logic_error{"erase is not supported"};
+    }
+
+    std::size_t size(void) {
+      return this->vec.size();
+    }
+  };
+
+  // The sequential and blocking vectors share an interface, without a
+  // conditional write. They throw rather than fail.
+  template <typename Vector, typename T>
+  struct plain_adapter {
+    static const bool has_write = false;
+
+    Vector vec;
+
+    plain_adapter(const std::size_t) {
+    }
+
+    bool push_back(const std::size_t, T* const x) {
+      this->vec.push_back(x);
+      return true;
+    }
+
+    bool pop_back(const std::size_t) {
+      this->vec.pop_back();
+      return true;
+    }
+
+    T* at(const std::size_t, const std::size_t pos) {
+      return this->vec.at(pos);
+    }
+
+    bool write(const std::size_t, const std::size_t, T* const) {
+      throw std::logic_error{"write is not supported"};
+    }
+
+    bool insert(const std::size_t, const std::size_t pos, T* const x) {
+      this->vec.insert(pos, x);
+      return true;
+    }
+
+    bool erase(const std::size_t, const std::size_t pos) {
+      this->vec.erase(pos);
+      return true;
+    }
+
+    std::size_t size(void) {
+      return this->vec.size();
+    }
+  };
+
+  template <typename T, typename Growth>
+  struct adapter<sequential::vector<T, Growth>>
+      : plain_adapter<sequential::vector<T, Growth>, T> {
+    static const bool thread_safe = false;
+
+    using plain_adapter<sequential::vector<T, Growth>, T>::plain_adapter;
+  };
+
+#ifdef WITH_MRLOCK
+  template <typename T, typename Growth>
+  struct adapter<blocking::vector<T, Growth>>
+      : plain_adapter<blocking::vector<T, Growth>, T> {
+    static const bool thread_safe = true;
+
+    using plain_adapter<blocking::vector<T, Growth>, T>::plain_adapter;
+  };
+#endif
+}; // namespace bench
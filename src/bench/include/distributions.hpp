@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Picks the index each operation works on. The vector changes size under
+// the benchmark, so distributions are drawn over ranks and mapped onto the
+// current size.
+namespace bench {
+
+  enum Distribution { UNIFORM, ZIPF, TAIL };
+
+  // Zipfian ranks over [0, Ranks) with exponent s, from a precomputed CDF.
+  // Ranks past the size of the vector wrap around.
+  struct zipf_table {
+    static const std::size_t Ranks = 1 << 16;
+
+    std::vector<double> cdf;
+
+    zipf_table(const double s) : cdf(Ranks) {
+      double sum = 0;
+      for (std::size_t i = 0; i < Ranks; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+        this->cdf[i] = sum;
+      }
+      for (auto& c : this->cdf) {
+        c /= sum;
+      }
+    }
+
+    std::size_t rank(const double u) const {
+      auto it = std::lower_bound(this->cdf.begin(), this->cdf.end(), u);
+      return std::min<std::size_t>(it - this->cdf.begin(), Ranks - 1);
+    }
+  };
+
+  // per-thread index generator
+  struct index_picker {
+    const Distribution dist;
+    const zipf_table* const zipf;
+    std::mt19937_64 gen;
+    std::uniform_real_distribution<double> unit;
+
+    index_picker(const Distribution dist, const zipf_table* zipf,
+                 const std::size_t seed)
+        : dist(dist), zipf(zipf), gen(seed), unit(0.0, 1.0) {
+    }
+
+    // an index below size, which must not be zero
+    std::size_t pick(const std::size_t size) {
+      switch (this->dist) {
+        case Distribution::UNIFORM:
+          return this->gen() % size;
+        case Distribution::ZIPF:
+          return this->zipf->rank(this->unit(this->gen)) % size;
+        case Distribution::TAIL:
+          return size - 1 - this->zipf->rank(this->unit(this->gen)) % size;
+      }
+      throw std::logic_error{"bad distribution"};
+    }
+
+    // a number in [0, n)
+    unsigned below(const unsigned n) {
+      return this->gen() % n;
+    }
+  };
+}; // namespace bench
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+  // Latency histogram in the style of HdrHistogram: values below Sub are
+  // counted exactly, and every power of two above that is split into Sub
+  // equal buckets, so any value is off by at most 1/Sub (about 3%). Recording
+  // is a bit scan and an increment; each thread keeps its own and they are
+  // merged at the end.
+  struct histogram {
+    static const unsigned SubBits = 5;
+    static const std::uint64_t Sub = std::uint64_t{1} << SubBits;
+    static const std::size_t NumBuckets = (64 - SubBits + 1) * Sub;
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total;
+    std::uint64_t max;
+
+    histogram(void) : counts(NumBuckets), total(0), max(0) {
+    }
+
+    static std::size_t bucket_of(const std::uint64_t v) {
+      if (v < Sub) {
+        return v;
+      }
+      const unsigned shift = (63 - __builtin_clzll(v)) - SubBits;
+      return (shift + 1) * Sub + ((v >> shift) & (Sub - 1));
+    }
+
+    // the largest value that falls in bucket b
+    static std::uint64_t bucket_top(const std::size_t b) {
+      if (b < Sub) {
+        return b;
+      }
+      const unsigned shift = b / Sub - 1;
+      const std::uint64_t low = (Sub | (b % Sub)) << shift;
+      return low + ((std::uint64_t{1} << shift) - 1);
+    }
+
+    void record(const std::uint64_t v) {
+      ++this->counts[bucket_of(v)];
+      ++this->total;
+      this->max = std::max(this->max, v);
+    }
+
+    void merge(const histogram& other) {
+      for (std::size_t b = 0; b < NumBuckets; ++b) {
+        this->counts[b] += other.counts[b];
+      }
+      this->total += other.total;
+      this->max = std::max(this->max, other.max);
+    }
+
+    // the value below which a fraction q of the recorded values fall
+    std::uint64_t percentile(const double q) const {
+      if (this->total == 0) {
+        return 0;
+      }
+
+      const std::uint64_t rank = std::max<std::uint64_t>(
+          1, static_cast<std::uint64_t>(q * this->total + 0.5));
+      std::uint64_t seen = 0;
+      for (std::size_t b = 0; b < NumBuckets; ++b) {
+        seen += this->counts[b];
+        if (seen >= rank) {
+          return std::min(bucket_top(b), this->max);
+        }
+      }
+      return this->max;
+    }
+  };
+}; // namespace bench
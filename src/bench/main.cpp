@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/adapters.hpp"
+#include "include/distributions.hpp"
+#include "include/histogram.hpp"
+
+namespace bench {
+
+  enum Op { PUSH, POP, READ, WRITE, INSERT, ERASE, NUM_OPS };
+
+  const char* const OpNames[NUM_OPS] = {"push",  "pop",    "read",
+                                        "write", "insert", "erase"};
+
+  struct options {
+    std::string impl = "waitfree";
+    std::string reclaimer = "epoch";
+    std::string storage = "contiguous";
+    // relative weights of each op
+    unsigned mix[NUM_OPS] = {25, 0, 25, 0, 25, 25};
+    std::size_t duration_ms = 1000;
+    std::size_t prefill = 10;
+    std::vector<std::size_t> threads = {1, 2, 4, 8};
+    std::string dist = "uniform";
+    double zipf_s = 0.99;
+    std::string format = "csv";
+    // time every op into per-op histograms
+    bool latency = false;
+  };
+
+  struct result {
+    std::size_t threads;
+    // ops that did what they were asked; the throughput counts only these
+    std::size_t ops;
+    // ops that failed, threw or found the vector empty
+    std::size_t failed;
+    double seconds;
+    // nanoseconds per op, by op; empty unless opts.latency
+    std::vector<histogram> latency;
+  };
+
+  // reported for every op in the mix when timing ops
+  const double Percentiles[] = {0.5, 0.99, 0.999};
+  const char* const PercentileNames[] = {"p50", "p99", "p999"};
+
+  void usage(void) {
+    std::cerr
+        << "usage: bench.out [options]\n"
+           "  --impl sequential|blocking|waitfree|append\n"
+           "        (default waitfree); append pushes and reads only\n"
+           "  --reclaimer epoch|hazard              waitfree and append\n"
+           "  --storage contiguous|reserved|segmented|bounded\n"
+           "        waitfree only; bounded holds 2^20 elements\n"
+           "  --mix push=25,read=25,insert=25,erase=25\n"
+           "        weights of push, pop, read, write, insert and erase;\n"
+           "        ops left out get 0\n"
+           "  --duration MS                         per thread count\n"
+           "  --prefill N                           elements to start with\n"
+           "  --threads 1,2,4-8                     thread counts to run\n"
+           "  --dist uniform|zipf[:S]|tail[:S]      index distribution;\n"
+           "        zipf favours the front, tail the back (S = 0.99)\n"
+           "  --format csv|json\n"
+           "  --latency                             also report p50, p99,\n"
+           "        p99.9 and max latency of each op, in ns\n";
+  }
+
+  std::vector<std::string> split(const std::string& s, const char sep) {
+    std::vector<std::string> parts;
+    std::stringstream ss(s);
+    for (std::string part; std::getline(ss, part, sep);) {
+      parts.push_back(part);
+    }
+    return parts;
+  }
+
+  std::vector<std::size_t> parse_threads(const std::string& s) {
+    std::vector<std::size_t> counts;
+    for (const auto& part : split(s, ',')) {
+      const auto dash = part.find('-');
+      if (dash == std::string::npos) {
+        counts.push_back(std::stoul(part));
+        continue;
+      }
+      const std::size_t lo = std::stoul(part.substr(0, dash));
+      const std::size_t hi = std::stoul(part.substr(dash + 1));
+      for (std::size_t n = lo; n <= hi; ++n) {
+        counts.push_back(n);
+      }
+    }
+    for (const auto n : counts) {
+      if (n == 0) {
+        throw std::invalid_argument{"thread counts must be positive"};
+      }
+    }
+    return counts;
+  }
+
+  void parse_mix(const std::string& s, unsigned mix[NUM_OPS]) {
+    std::fill(mix, mix + NUM_OPS, 0);
+    for (const auto& part : split(s, ',')) {
+      const auto eq = part.find('=');
+      const std::string name = part.substr(0, eq);
+      const auto op = std::find(OpNames, OpNames + NUM_OPS, name);
+      if (eq == std::string::npos || op == OpNames + NUM_OPS) {
+        throw std::invalid_argument{"bad mix entry " + part};
+      }
+      mix[op - OpNames] = std::stoul(part.substr(eq + 1));
+    }
+  }
+
+  options parse(int argc, char** argv) {
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+      const std::string flag = argv[i];
+      if (flag == "--help" || flag == "-h") {
+        usage();
+        std::exit(0);
+      }
+      if (flag == "--latency") {
+        opts.latency = true;
+        continue;
+      }
+      if (i + 1 >= argc) {
+        throw std::invalid_argument{"missing value for " + flag};
+      }
+      const std::string value = argv[++i];
+
+      if (flag == "--impl") {
+        opts.impl = value;
+      } else if (flag == "--reclaimer") {
+        opts.reclaimer = value;
+      } else if (flag == "--storage") {
+        opts.storage = value;
+      } else if (flag == "--mix") {
+        parse_mix(value, opts.mix);
+      } else if (flag == "--duration") {
+        opts.duration_ms = std::stoul(value);
+      } else if (flag == "--prefill") {
+        opts.prefill = std::stoul(value);
+      } else if (flag == "--threads") {
+        opts.threads = parse_threads(value);
+      } else if (flag == "--dist") {
+        const auto colon = value.find(':');
+        opts.dist = value.substr(0, colon);
+        if (colon != std::string::npos) {
+          opts.zipf_s = std::stod(value.substr(colon + 1));
+        }
+      } else if (flag == "--format") {
+        opts.format = value;
+      } else {
+        throw std::invalid_argument{"unknown option " + flag};
+      }
+    }
+    return opts;
+  }
+
+  Distribution distribution(const std::string& name) {
+    if (name == "uniform") {
+      return Distribution::UNIFORM;
+    } else if (name == "zipf") {
+      return Distribution::ZIPF;
+    } else if (name == "tail") {
+      return Distribution::TAIL;
+    }
+    throw std::invalid_argument{"unknown distribution " + name};
+  }
+
+  // values the vectors point at; never freed, never allocated per op
+  int values[1024];
+
+  // runs the mix on `num_threads` threads for opts.duration_ms
+  template <typename Adapter>
+  result run(const options& opts, const std::size_t num_threads) {
+    if (!Adapter::thread_safe && num_threads > 1) {
+      throw std::invalid_argument{opts.impl +
+                                  " only runs with a single thread"};
+    }
+    if (!Adapter::has_write && opts.mix[WRITE] != 0) {
+      throw std::invalid_argument{opts.impl + " has no write"};
+    }
+
+    unsigned total = 0;
+    for (const auto w : opts.mix) {
+      total += w;
+    }
+    if (total == 0) {
+      throw std::invalid_argument{"the mix is empty"};
+    }
+
+    const Distribution dist = distribution(opts.dist);
+    const zipf_table zipf(opts.zipf_s);
+
+    Adapter vec(num_threads);
+    for (std::size_t i = 0; i < opts.prefill; ++i) {
+      vec.push_back(0, &values[i % 1024]);
+    }
+
+    std::atomic<std::size_t> ready(0);
+    std::atomic_bool go(false), stop(false);
+    std::vector<std::size_t> done(num_threads), failed(num_threads);
+    std::vector<std::vector<histogram>> latency(num_threads);
+
+    auto work = [&](const std::size_t tid) {
+      typedef std::chrono::steady_clock clock;
+
+      index_picker picker(dist, &zipf, tid + 1);
+      std::size_t ops = 0, fails = 0;
+      std::vector<histogram> hist(opts.latency ? NUM_OPS : 0);
+
+      ++ready;
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+
+      while (!stop.load()) {
+        unsigned w = picker.below(total);
+        int op = 0;
+        while (w >= opts.mix[op]) {
+          w -= opts.mix[op++];
+        }
+
+        int* const x = &values[(ops + fails) % 1024];
+        const auto began = opts.latency ? clock::now() : clock::time_point{};
+        bool ok = false;
+        try {
+          const std::size_t size = vec.size();
+          switch (op) {
+            case Op::PUSH:
+              ok = vec.push_back(tid, x);
+              break;
+            case Op::POP:
+              ok = vec.pop_back(tid);
+              break;
+            case Op::READ:
+              ok = size > 0 && vec.at(tid, picker.pick(size)) != nullptr;
+              break;
+            case Op::WRITE:
+              ok = size > 0 && vec.write(tid, picker.pick(size), x);
+              break;
+            case Op::INSERT:
+              ok = vec.insert(tid, size > 0 ? picker.pick(size) : 0, x);
+              break;
+            case Op::ERASE:
+              ok = size > 0 && vec.erase(tid, picker.pick(size));
+              break;
+          }
+        } catch (...) {
+        }
+        ++(ok ? ops : fails);
+        if (opts.latency) {
+          hist[op].record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              clock::now() - began)
+                              .count());
+        }
+      }
+      done[tid] = ops;
+      failed[tid] = fails;
+      latency[tid] = std::move(hist);
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back(work, tid);
+    }
+    while (ready.load() < num_threads) {
+      std::this_thread::yield();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(opts.duration_ms));
+    stop.store(true);
+    for (auto& t : threads) {
+      t.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    result res{num_threads, 0, 0,
+               std::chrono::duration<double>(end - start).count(),
+               std::vector<histogram>(opts.latency ? NUM_OPS : 0)};
+    for (std::size_t tid = 0; tid < num_threads; ++tid) {
+      res.ops += done[tid];
+      res.failed += failed[tid];
+      for (std::size_t op = 0; op < res.latency.size(); ++op) {
+        res.latency[op].merge(latency[tid][op]);
+      }
+    }
+    return res;
+  }
+
+  template <typename Adapter>
+  std::vector<result> run_all(const options& opts) {
+    std::vector<result> results;
+    for (const auto n : opts.threads) {
+      results.push_back(run<Adapter>(opts, n));
+    }
+    return results;
+  }
+
+  template <typename Reclaimer>
+  std::vector<result> run_waitfree(const options& opts) {
+    typedef growth::doubling G;
+    if (opts.storage == "contiguous") {
+      return run_all<adapter<waitfree::vector<int, Reclaimer, G>>>(opts);
+    } else if (opts.storage == "reserved") {
+      return run_all<adapter<waitfree::vector<
+          int, Reclaimer, G, waitfree::reserved_storage<>>>>(opts);
+    } else if (opts.storage == "segmented") {
+      return run_all<adapter<waitfree::vector<
+          int, Reclaimer, G, waitfree::segmented_storage<>>>>(opts);
+    } else if (opts.storage == "bounded") {
+      return run_all<
+          adapter<waitfree::bounded_vector<int, (1 << 20), Reclaimer>>>(opts);
+    }
+    throw std::invalid_argument{"unknown storage " + opts.storage};
+  }
+
+  std::vector<result> run_impl(const options& opts) {
+    if (opts.impl == "sequential") {
+      return run_all<adapter<sequential::vector<int>>>(opts);
+    } else if (opts.impl == "blocking") {
+#ifdef WITH_MRLOCK
+      return run_all<adapter<blocking::vector<int>>>(opts);
+#else
+      throw std::invalid_argument{"built without MRLock; use make "
+                                  "bench_mrlock"};
+#endif
+    } else if (opts.impl == "waitfree") {
+      if (opts.reclaimer == "epoch") {
+        return run_waitfree<waitfree::epoch_reclaimer>(opts);
+      } else if (opts.reclaimer == "hazard") {
+        return run_waitfree<waitfree::hazard_reclaimer>(opts);
+      }
+      throw std::invalid_argument{"unknown reclaimer " + opts.reclaimer};
+    } else if (opts.impl == "append") {
+      if (opts.reclaimer == "epoch") {
+        return run_all<adapter<
+            waitfree::append_only_vector<int, waitfree::epoch_reclaimer>>>(
+            opts);
+      } else if (opts.reclaimer == "hazard") {
+        return run_all<adapter<
+            waitfree::append_only_vector<int, waitfree::hazard_reclaimer>>>(
+            opts);
+      }
+      throw std::invalid_argument{"unknown reclaimer " + opts.reclaimer};
+    }
+    throw std::invalid_argument{"unknown implementation " + opts.impl};
+  }
+
+  std::string mix_string(const options& opts) {
+    std::string s;
+    for (int op = 0; op < NUM_OPS; ++op) {
+      if (opts.mix[op] != 0) {
+        s += (s.empty() ? "" : " ") + std::string(OpNames[op]) + "=" +
+             std::to_string(opts.mix[op]);
+      }
+    }
+    return s;
+  }
+
+  void print(const options& opts, const std::vector<result>& results) {
+    const bool waitfree = opts.impl == "waitfree";
+    const std::string reclaimer =
+        waitfree || opts.impl == "append" ? opts.reclaimer : "";
+    const std::string storage = waitfree ? opts.storage : "";
+
+    if (opts.format == "json") {
+      std::cout << "[\n";
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        std::cout << "  {\"impl\": \"" << opts.impl << "\", \"reclaimer\": \""
+                  << reclaimer << "\", \"storage\": \"" << storage
+                  << "\", \"mix\": \"" << mix_string(opts)
+                  << "\", \"dist\": \"" << opts.dist
+                  << "\", \"prefill\": " << opts.prefill
+                  << ", \"threads\": " << r.threads << ", \"ops\": " << r.ops
+                  << ", \"failed\": " << r.failed
+                  << ", \"seconds\": " << r.seconds
+                  << ", \"ops_per_sec\": " << r.ops / r.seconds;
+        if (opts.latency) {
+          std::cout << ", \"latency_ns\": {";
+          bool first = true;
+          for (int op = 0; op < NUM_OPS; ++op) {
+            if (opts.mix[op] == 0) {
+              continue;
+            }
+            const histogram& h = r.latency[op];
+            std::cout << (first ? "" : ", ") << "\"" << OpNames[op]
+                      << "\": {\"count\": " << h.total;
+            for (int p = 0; p < 3; ++p) {
+              std::cout << ", \"" << PercentileNames[p]
+                        << "\": " << h.percentile(Percentiles[p]);
+            }
+            std::cout << ", \"max\": " << h.max << "}";
+            first = false;
+          }
+          std::cout << "}";
+        }
+        std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+      }
+      std::cout << "]\n";
+      return;
+    }
+
+    std::cout << "impl,reclaimer,storage,mix,dist,prefill,threads,ops,failed,"
+                 "seconds,ops_per_sec";
+    if (opts.latency) {
+      for (int op = 0; op < NUM_OPS; ++op) {
+        if (opts.mix[op] == 0) {
+          continue;
+        }
+        for (const auto name : PercentileNames) {
+          std::cout << "," << OpNames[op] << "_" << name << "_ns";
+        }
+        std::cout << "," << OpNames[op] << "_max_ns";
+      }
+    }
+    std::cout << "\n";
+
+    for (const auto& r : results) {
+      std::cout << opts.impl << "," << reclaimer << "," << storage << ","
+                << mix_string(opts) << "," << opts.dist << "," << opts.prefill
+                << "," << r.threads << "," << r.ops << "," << r.failed << ","
+                << r.seconds << "," << r.ops / r.seconds;
+      if (opts.latency) {
+        for (int op = 0; op < NUM_OPS; ++op) {
+          if (opts.mix[op] == 0) {
+            continue;
+          }
+          for (const auto p : Percentiles) {
+            std::cout << "," << r.latency[op].percentile(p);
+          }
+          std::cout << "," << r.latency[op].max;
+        }
+      }
+      std::cout << "\n";
+    }
+  }
+}; // namespace bench
+
+int main(int argc, char** argv) {
+  try {
+    const bench::options opts = bench::parse(argc, argv);
+    if (opts.format != "csv" && opts.format != "json") {
+      throw std::invalid_argument{"unknown format " + opts.format};
+    }
+    bench::print(opts, bench::run_impl(opts));
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    bench::usage();
+    return 1;
+  }
+
+  return 0;
+}
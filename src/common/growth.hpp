@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+// Growth policies shared by all three vectors. A policy is a type with
+//   static std::size_t grow(std::size_t capacity)
+// returning the capacity to grow a full array to; it must be larger than
+// `capacity`. Any such type can be passed as a custom policy.
+namespace growth {
+
+  // capacity * 2 + 1; the default
+  struct doubling {
+    static std::size_t grow(const std::size_t capacity) {
+      return capacity * 2 + 1;
+    }
+  };
+
+  // less slack than doubling, at the cost of more copies
+  struct one_and_a_half {
+    static std::size_t grow(const std::size_t capacity) {
+      return capacity + capacity / 2 + 1;
+    }
+  };
+
+  // grows by a constant number of elements: the least slack, but the number
+  // of copies grows with the size
+  template <std::size_t Chunk>
+  struct fixed_chunk {
+    static_assert(Chunk > 0, "chunk must not be empty");
+
+    static std::size_t grow(const std::size_t capacity) {
+      return capacity + Chunk;
+    }
+  };
+}; // namespace growth
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+#include "vector.hpp"
+
+namespace waitfree {
+
+  // A vector that only ever grows, for logs and id tables. A push claims its
+  // index with a single fetch_add on the size and publishes the value with a
+  // single CAS, so there are no descriptors, no helping and no retry loop
+  // beyond the resizes it runs into.
+  //
+  // The size counts claimed slots, some of which may not have been published
+  // yet: at() and read() report a slot that is still NotValue as absent.
+  //
+  // Built on the wait-free vector with Contiguous storage, whose resize,
+  // reclamation and thread registration it reuses unchanged.
+  template <typename E, typename Reclaimer = epoch_reclaimer,
+            typename Growth = growth::doubling>
+  struct append_only_vector {
+    typedef vector<E, Reclaimer, Growth, contiguous_storage> vector_type;
+    typedef typename vector_type::value_type value_type;
+    typedef typename vector_type::element_type element_type;
+    typedef typename vector_type::slot_type T;
+    typedef typename vector_type::codec codec;
+    typedef typename vector_type::registration registration;
+
+    vector_type _vec;
+
+    append_only_vector(std::size_t num_threads, std::size_t capacity = 0)
+        : _vec(num_threads, capacity) {
+    }
+
+    append_only_vector(const append_only_vector&) = delete;
+    append_only_vector& operator=(const append_only_vector&) = delete;
+
+    registration register_thread(void) {
+      return this->_vec.register_thread();
+    }
+
+    // Appends `element` and returns its index.
+    std::size_t push_back(const std::size_t tid, const element_type element) {
+      T* const value = codec::encode(element);
+      if (value == nullptr) {
+        throw std::runtime_error("cannot push_back nullptr!!");
+      }
+
+      const typename vector_type::operation guard(&this->_vec, tid);
+
+      const std::size_t pos = this->_vec._size.fetch_add(1);
+      for (;;) {
+        std::atomic<T*>& spot = this->_vec.getSpot(tid, pos);
+        T* expected = reinterpret_cast<T*>(NotValue);
+        if (spot.compare_exchange_strong(expected, value)) {
+          return pos;
+        }
+        // a resize froze the slot before we got to it; it is NotValue in
+        // the array that replaced this one
+        bump(this->_vec.counters(tid).cas_failures);
+      }
+    }
+
+    std::pair<bool, element_type> at(const std::size_t tid,
+                                     const std::size_t pos) {
+      return this->_vec.at(tid, pos);
+    }
+
+    std::pair<bool, element_type> read(const std::size_t pos) {
+      return this->_vec.read(pos);
+    }
+
+    std::size_t size(void) const {
+      return this->_vec.size();
+    }
+
+    std::size_t capacity(void) const {
+      return this->_vec.capacity();
+    }
+
+    void reserve(const std::size_t tid, const std::size_t n) {
+      this->_vec.reserve(tid, n);
+    }
+
+    const thread_stats& stats(const std::size_t tid) const {
+      return this->_vec.stats(tid);
+    }
+
+    vector_stats stats(void) {
+      return this->_vec.stats();
+    }
+  };
+}; // namespace waitfree
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+#include "../../common/growth.hpp"
+#include "reclamation.hpp"
+
+namespace waitfree {
+
+  // Storage for at most N elements, allocated in one piece with the slots
+  // inline. Nothing is ever copied, so getSpot is a single index: no
+  // capacity check against a growing array, no NotCopied or Resize slots
+  // and no resize path. Pushes past N throw instead.
+  //
+  // There is one slot more than N, because a pop works on the slot past the
+  // last element. Exposes the same interface the vector uses on Contiguous;
+  // resize() always throws and the generation never changes.
+  template <typename V, std::size_t N>
+  struct Bounded {
+    typedef typename V::slot_type T;
+
+    static const bool Replaceable = false;
+    static const std::size_t MaxSize = N;
+
+    V* vec;
+    const std::size_t capacity;
+    const std::size_t generation;
+
+    std::atomic<T*> array[N + 1];
+
+    // the whole array exists from the start, so the initial capacity asked
+    // for only has to fit
+    Bounded(V* vec, Bounded*, std::size_t capacity)
+        : vec(vec), capacity(N), generation(0) {
+      if (capacity > N) {
+        throw std::runtime_error{"bounded storage is full"};
+      }
+      for (auto& slot : this->array) {
+        slot.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    Bounded(const Bounded&) = delete;
+    Bounded& operator=(const Bounded&) = delete;
+
+    Bounded* resize(const std::size_t, const std::size_t = 0) {
+      throw std::runtime_error{"bounded storage is full"};
+    }
+
+    std::size_t chain_depth(void) const {
+      return 1;
+    }
+
+    std::atomic<T*>& getSpot(const std::size_t, const std::size_t pos) {
+      assert(pos <= N);
+      return this->array[pos];
+    }
+
+    // the value at `pos` without writing anything; NotValue past the end
+    T* peek(const std::size_t pos) {
+      if (pos > N) {
+        return nullptr;
+      }
+      return this->array[pos].load();
+    }
+  };
+
+  // Storage policy selecting Bounded, for vectors that never hold more than
+  // N elements.
+  template <std::size_t N>
+  struct bounded_storage {
+    template <typename V>
+    using type = Bounded<V, N>;
+  };
+
+  template <typename T, typename Reclaimer, typename Growth, typename Storage,
+            std::size_t MaxThreads>
+  struct vector;
+
+  // A vector of at most N elements, kept inline in its storage. MaxThreads
+  // is as for vector, sized at run time by default.
+  template <typename T, std::size_t N, typename Reclaimer = epoch_reclaimer,
+            std::size_t MaxThreads = 0>
+  using bounded_vector =
+      vector<T, Reclaimer, growth::doubling, bounded_storage<N>, MaxThreads>;
+}; // namespace waitfree
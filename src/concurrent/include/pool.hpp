@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "reclamation.hpp"
+
+namespace waitfree {
+
+  // indices of the per-thread free lists, one per kind of object the vector
+  // allocates
+  enum PoolKind {
+    PUSH_DESCR_POOL,
+    POP_DESCR_POOL,
+    POP_SUB_DESCR_POOL,
+    WRITE_OP_DESCR_POOL,
+    INSERT_SHIFT_DESCR_POOL,
+    ERASE_SHIFT_DESCR_POOL,
+    PUSH_RANGE_DESCR_POOL,
+    POP_OP_POOL,
+    PUSH_OP_POOL,
+    WRITE_OP_POOL,
+    INSERT_SHIFT_OP_POOL,
+    ERASE_SHIFT_OP_POOL,
+    NUM_POOLS
+  };
+
+  // Per-thread free lists for the descriptors and ops of one vector, so that
+  // the common path does not go to malloc. A block is only ever touched by
+  // the thread that owns the pool: objects are allocated by the thread
+  // starting an attempt and recycled by whichever thread reclaims them, into
+  // that thread's own pool.
+  struct alignas(CACHE_LINE_SIZE) object_pool {
+    // blocks kept per kind; anything beyond goes back to the heap
+    static const std::size_t MaxCached = 256;
+
+    std::vector<void*> _free[NUM_POOLS];
+
+    object_pool(void) {
+      for (auto& list : this->_free) {
+        list.reserve(MaxCached);
+      }
+    }
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    ~object_pool(void) {
+      for (auto& list : this->_free) {
+        for (void* p : list) {
+          ::operator delete(p);
+        }
+      }
+    }
+
+    template <typename U, typename... Args>
+    U* make(Args&&... args) {
+      auto& list = this->_free[U::pool_kind];
+
+      void* p;
+      if (list.empty()) {
+        p = ::operator new(sizeof(U));
+      } else {
+        p = list.back();
+        list.pop_back();
+      }
+
+      return new (p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void recycle(U* obj) {
+      obj->~U();
+
+      auto& list = this->_free[U::pool_kind];
+      if (list.size() < MaxCached) {
+        list.push_back(obj);
+      } else {
+        ::operator delete(obj);
+      }
+    }
+  };
+
+  // allocates a U out of the calling thread's pool in `vec`
+  template <typename U, typename V, typename... Args>
+  U* make(V* vec, const std::size_t tid, Args&&... args) {
+    return vec->pool(tid).template make<U>(std::forward<Args>(args)...);
+  }
+}; // namespace waitfree
@@ -0,0 +1,741 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "stats.hpp"
+
+namespace waitfree {
+
+  const std::size_t CACHE_LINE_SIZE = 64;
+
+  // Base for everything the vector allocates and shares between threads
+  // (descriptors and ops). Objects that can be reached through another shared
+  // object (e.g. a descriptor's owner op) are reference counted so that they
+  // outlive everything that points at them; the creator holds the first
+  // reference and gives it up through the reclaimer.
+  //
+  // Dropping a reference takes the calling thread's tid: the last one hands
+  // the object to recycle(), which returns it to that thread's pool and
+  // releases whatever it held.
+  struct reclaimable {
+    std::atomic<std::size_t> refs;
+
+    reclaimable(void) : refs(1) {
+    }
+
+    virtual ~reclaimable(void) {
+    }
+
+    void acquire(void) {
+      this->refs.fetch_add(1);
+    }
+
+    void release(const std::size_t tid) {
+      if (this->refs.fetch_sub(1) == 1) {
+        this->recycle(tid);
+      }
+    }
+
+    virtual void recycle(const std::size_t tid) = 0;
+
+    // deleter handed to the reclaimer
+    static void reclaim(void* p, const std::size_t tid) {
+      static_cast<reclaimable*>(p)->release(tid);
+    }
+  };
+
+  // raises `a` to at least `value`
+  inline void atomic_max(std::atomic<std::size_t>& a, const std::size_t value) {
+    std::size_t current = a.load();
+    while (current < value && !a.compare_exchange_weak(current, value)) {
+    }
+  }
+
+  // The thread slots in use, one bit each. A slot joins on its first use
+  // and leaves when it is given back, so scans and helping only visit the
+  // slots of threads that are still around. Joining checks the bit before
+  // setting it, so a thread only writes the shared words when its slot
+  // changes hands.
+  struct slot_set {
+    static const std::size_t Bits = 64;
+
+    const std::size_t _words;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> _bits;
+
+    slot_set(const std::size_t num_slots)
+        : _words((num_slots + Bits - 1) / Bits),
+          _bits(new std::atomic<std::uint64_t>[_words]) {
+      for (std::size_t w = 0; w < this->_words; ++w) {
+        this->_bits[w].store(0);
+      }
+    }
+
+    static std::uint64_t bit(const std::size_t slot) {
+      return std::uint64_t{1} << (slot % Bits);
+    }
+
+    void add(const std::size_t slot) {
+      auto& word = this->_bits[slot / Bits];
+      if (!(word.load(std::memory_order_relaxed) & bit(slot))) {
+        word.fetch_or(bit(slot));
+      }
+    }
+
+    // adds `slot` unless it is in already; returns whether it was added
+    bool claim(const std::size_t slot) {
+      return !(this->_bits[slot / Bits].fetch_or(bit(slot)) & bit(slot));
+    }
+
+    void remove(const std::size_t slot) {
+      this->_bits[slot / Bits].fetch_and(~bit(slot));
+    }
+
+    std::size_t count(void) const {
+      std::size_t n = 0;
+      for (std::size_t w = 0; w < this->_words; ++w) {
+        n += __builtin_popcountll(this->_bits[w].load());
+      }
+      return n;
+    }
+
+    // calls f(slot) for every slot in the set
+    template <typename F>
+    void for_each(F f) const {
+      for (std::size_t w = 0; w < this->_words; ++w) {
+        for (std::uint64_t bits = this->_bits[w].load(); bits != 0;
+             bits &= bits - 1) {
+          f(w * Bits + __builtin_ctzll(bits));
+        }
+      }
+    }
+
+    // whether f(slot) holds for some slot in the set; stops at the first
+    template <typename F>
+    bool any(F f) const {
+      for (std::size_t w = 0; w < this->_words; ++w) {
+        for (std::uint64_t bits = this->_bits[w].load(); bits != 0;
+             bits &= bits - 1) {
+          if (f(w * Bits + __builtin_ctzll(bits))) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    // the first slot in the set after `cursor`, wrapping round; `cursor`
+    // itself if the set is otherwise empty
+    std::size_t next(const std::size_t cursor) const {
+      std::size_t slot = cursor + 1;
+      for (std::size_t i = 0; i <= this->_words; ++i) {
+        if (slot >= this->_words * Bits) {
+          slot = 0;
+        }
+        const std::uint64_t bits =
+            this->_bits[slot / Bits].load() >> (slot % Bits);
+        if (bits != 0) {
+          return slot + __builtin_ctzll(bits);
+        }
+        slot = (slot / Bits + 1) * Bits;
+      }
+      return cursor;
+    }
+  };
+
+  struct retired_node {
+    void* ptr;
+    void (*reclaim)(void*, std::size_t);
+  };
+
+  // Reclamation policies.
+  //
+  // A policy is a template argument of waitfree::vector and provides:
+  //   - enter(tid) / leave(tid), bracketing every vector operation. Scans
+  //     only look at the records of tids that have entered and not been
+  //     released since, so unused slots cost nothing. The vector checks tid
+  //     before entering; the policy only asserts it
+  //   - release_slot(tid), once the thread in slot tid is done with the
+  //     vector, so that scans skip the slot until it enters again
+  //   - retire(tid, ptr, reclaim), for objects already unlinked from the
+  //     vector. reclaim(ptr, tid) is later called by the thread `tid` that
+  //     frees it
+  //   - a `hazard` type: a scoped guard whose protect(ptr, still_reachable)
+  //     must succeed before `ptr`, freshly read from shared memory, is
+  //     dereferenced. still_reachable() re-checks the location ptr was read
+  //     from; if protect() returns false, ptr must not be used.
+  //   - protect_generation(tid, current) / retire_generation(tid, gen, ...),
+  //     for the storage arrays. Threads hold references into those for a
+  //     whole operation, so they are protected by generation rather than by
+  //     address: after protect_generation() the thread may touch any array
+  //     from the predecessor of the current() one onwards.
+  //   - backlog(), the number of objects retired but not yet freed
+  //   - enter_reader() / leave_reader(record), bracketing reads by threads
+  //     without a tid. The reader gets a reader_record of its own, which
+  //     stands in for a thread record: its protect_generation() and
+  //     protect() work like the ones above. See reader_section.
+
+  // The records of readers without a tid, one for each reader inside at a
+  // time. A reader takes any free record, and adds a new one if they are
+  // all taken, so readers never wait for each other and each only writes
+  // to its own record. Records are kept until the reclaimer is destroyed,
+  // and scans look at all of them.
+  template <typename Record>
+  struct reader_list {
+    std::atomic<Record*> _head;
+
+    reader_list(void) : _head(nullptr) {
+    }
+
+    reader_list(const reader_list&) = delete;
+    reader_list& operator=(const reader_list&) = delete;
+
+    ~reader_list(void) {
+      for (Record* r = this->_head.load(); r != nullptr;) {
+        Record* const next = r->next;
+        delete r;
+        r = next;
+      }
+    }
+
+    Record* acquire(void) {
+      for (Record* r = this->_head.load(); r != nullptr; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load(std::memory_order_relaxed) &&
+            r->in_use.compare_exchange_strong(expected, true)) {
+          return r;
+        }
+      }
+
+      Record* const r = new Record;
+      r->in_use.store(true, std::memory_order_relaxed);
+      Record* head = this->_head.load();
+      do {
+        r->next = head;
+      } while (!this->_head.compare_exchange_weak(head, r));
+      return r;
+    }
+
+    void release(Record* const r) {
+      r->in_use.store(false);
+    }
+
+    template <typename F>
+    void for_each(F f) const {
+      for (Record* r = this->_head.load(); r != nullptr; r = r->next) {
+        f(*r);
+      }
+    }
+  };
+
+  // Epoch-based reclamation (Fraser, 2004).
+  //
+  // Every vector operation runs in a critical section pinned to the global
+  // epoch the thread observed on entry. The global epoch only advances once
+  // every thread inside a critical section has observed the current one, so
+  // anything retired during epoch e is unreachable by everyone once the epoch
+  // reaches e + 2. Objects must be unlinked from the vector before they are
+  // retired.
+  //
+  // Cheapest per operation, but a thread stalled inside an operation keeps
+  // the epoch from advancing and nothing gets freed until it resumes.
+  struct epoch_reclaimer {
+    static const std::size_t Quiescent =
+        std::numeric_limits<std::size_t>::max();
+
+    // how many retires a thread does between attempts to advance the epoch
+    static const std::size_t AdvanceEvery = 64;
+
+    struct alignas(CACHE_LINE_SIZE) thread_record {
+      std::atomic<std::size_t> epoch;
+      std::size_t retired_since_advance;
+
+      std::vector<retired_node> limbo[3];
+      std::size_t limbo_epoch[3];
+      // objects in limbo, for backlog()
+      stat_counter backlog;
+
+      thread_record(void)
+          : epoch(Quiescent),
+            retired_since_advance(0),
+            limbo_epoch{},
+            backlog(0) {
+      }
+    };
+
+    const std::size_t _num_threads;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _epoch;
+    // tids that have entered and not been released since
+    slot_set _active;
+    thread_record* const _records;
+
+    // A reader without a tid, pinned to an epoch like a thread.
+    struct alignas(CACHE_LINE_SIZE) reader_record {
+      std::atomic_bool in_use;
+      std::atomic<std::size_t> epoch;
+      reader_record* next;
+
+      reader_record(void) : in_use(false), epoch(Quiescent), next(nullptr) {
+      }
+
+      // the pinned epoch already protects everything the reader gets to
+      template <typename F>
+      void protect_generation(F) {
+      }
+
+      template <typename F>
+      bool protect(const void*, F) {
+        return true;
+      }
+    };
+
+    reader_list<reader_record> _readers;
+
+    // the critical section already protects everything read inside it
+    struct hazard {
+      hazard(epoch_reclaimer&, std::size_t) {
+      }
+
+      template <typename F>
+      bool protect(const void*, F) {
+        return true;
+      }
+    };
+
+    epoch_reclaimer(std::size_t num_threads)
+        : _num_threads(num_threads),
+          _epoch(0),
+          _active(num_threads),
+          _records(new thread_record[num_threads]) {
+    }
+
+    epoch_reclaimer(const epoch_reclaimer&) = delete;
+    epoch_reclaimer& operator=(const epoch_reclaimer&) = delete;
+
+    ~epoch_reclaimer(void) {
+      for (std::size_t tid = 0; tid < this->_num_threads; ++tid) {
+        for (auto& bucket : this->_records[tid].limbo) {
+          free_all(tid, bucket);
+        }
+      }
+      delete[] this->_records;
+    }
+
+    void enter(const std::size_t tid) {
+      assert(tid < this->_num_threads);
+
+      // must be visible to try_advance before we pin an epoch
+      this->_active.add(tid);
+
+      this->_records[tid].epoch.store(this->_epoch.load());
+    }
+
+    void leave(const std::size_t tid) {
+      this->_records[tid].epoch.store(Quiescent);
+    }
+
+    void release_slot(const std::size_t tid) {
+      this->_active.remove(tid);
+    }
+
+    reader_record* enter_reader(void) {
+      reader_record* const rec = this->_readers.acquire();
+      rec->epoch.store(this->_epoch.load());
+      return rec;
+    }
+
+    void leave_reader(reader_record* const rec) {
+      rec->epoch.store(Quiescent);
+      this->_readers.release(rec);
+    }
+
+    template <typename F>
+    void protect_generation(const std::size_t, F) {
+    }
+
+    void retire_generation(const std::size_t tid, const std::size_t, void* ptr,
+                           void (*reclaim)(void*, std::size_t)) {
+      this->retire(tid, ptr, reclaim);
+    }
+
+    void retire(const std::size_t tid, void* ptr,
+                void (*reclaim)(void*, std::size_t)) {
+      thread_record& rec = this->_records[tid];
+      const std::size_t epoch = this->_epoch.load();
+
+      // buckets filled two or more epochs ago are safe to free
+      for (std::size_t i = 0; i < 3; ++i) {
+        if (rec.limbo_epoch[i] + 2 <= epoch) {
+          free_all(tid, rec.limbo[i]);
+        }
+      }
+
+      rec.limbo[epoch % 3].push_back(retired_node{ptr, reclaim});
+      rec.limbo_epoch[epoch % 3] = epoch;
+      set_stat(rec.backlog, rec.limbo[0].size() + rec.limbo[1].size() +
+                                rec.limbo[2].size());
+
+      if (++rec.retired_since_advance >= AdvanceEvery) {
+        rec.retired_since_advance = 0;
+        this->try_advance();
+      }
+    }
+
+    // released slots included, as their objects wait for the slot's reuse
+    std::size_t backlog(void) const {
+      std::size_t total = 0;
+      for (std::size_t tid = 0; tid < this->_num_threads; ++tid) {
+        total += this->_records[tid].backlog.load();
+      }
+      return total;
+    }
+
+    void try_advance(void) {
+      std::size_t epoch = this->_epoch.load();
+      if (this->_active.any([&](const std::size_t tid) {
+            const std::size_t e = this->_records[tid].epoch.load();
+            return e != Quiescent && e != epoch;
+          })) {
+        return;
+      }
+
+      bool behind = false;
+      this->_readers.for_each([&](const reader_record& r) {
+        const std::size_t e = r.epoch.load();
+        behind = behind || (e != Quiescent && e != epoch);
+      });
+      if (!behind) {
+        this->_epoch.compare_exchange_strong(epoch, epoch + 1);
+      }
+    }
+
+    static void free_all(const std::size_t tid,
+                         std::vector<retired_node>& bucket) {
+      for (const auto& r : bucket) {
+        r.reclaim(r.ptr, tid);
+      }
+      bucket.clear();
+    }
+  };
+
+  // Hazard pointers (Michael, 2004).
+  //
+  // Before dereferencing a descriptor or op it read from shared memory, a
+  // thread publishes its address in one of its hazard slots and re-validates
+  // that it is still reachable. A retired object is freed once no slot holds
+  // it, so a stalled thread pins only the few objects it has published and
+  // the amount of unreclaimed garbage stays bounded.
+  //
+  // Hazard slots are used as a stack: helping another thread's descriptor
+  // can require helping the descriptor it is blocked on, and so on. A reader
+  // without a tid only ever looks at one descriptor, and has one slot.
+  struct hazard_reclaimer {
+    // deepest chain of nested helping a thread can be in
+    static const std::size_t MaxHazards = 64;
+
+    // how many retires a thread does between scans of the hazard slots
+    static const std::size_t ScanEvery = 128;
+
+    static const std::size_t Unprotected =
+        std::numeric_limits<std::size_t>::max();
+
+    struct retired_storage {
+      retired_node node;
+      std::size_t generation;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) thread_record {
+      std::atomic<const void*> hazards[MaxHazards];
+      std::size_t depth;
+
+      // oldest storage generation this thread may be touching
+      std::atomic<std::size_t> generation;
+
+      std::vector<retired_node> retired;
+      std::vector<retired_storage> retired_arrays;
+
+      // scratch space for scan(), kept so that scanning does not allocate
+      std::vector<const void*> seen;
+      std::vector<retired_node> keep;
+      std::vector<retired_storage> keep_arrays;
+
+      // objects retired and not yet freed, for backlog()
+      stat_counter backlog;
+
+      thread_record(void) : depth(0), generation(Unprotected), backlog(0) {
+        for (auto& h : this->hazards) {
+          h.store(nullptr);
+        }
+      }
+    };
+
+    const std::size_t _num_threads;
+    // tids that have entered and not been released since
+    alignas(CACHE_LINE_SIZE) slot_set _active;
+    thread_record* const _records;
+
+    // A reader without a tid: the one descriptor it reads through, and the
+    // oldest storage generation it may be touching.
+    struct alignas(CACHE_LINE_SIZE) reader_record {
+      std::atomic_bool in_use;
+      std::atomic<const void*> hazard;
+      std::atomic<std::size_t> generation;
+      reader_record* next;
+
+      reader_record(void)
+          : in_use(false),
+            hazard(nullptr),
+            generation(Unprotected),
+            next(nullptr) {
+      }
+
+      template <typename F>
+      void protect_generation(F current) {
+        pin_generation(this->generation, current);
+      }
+
+      template <typename F>
+      bool protect(const void* ptr, F still_reachable) {
+        this->hazard.store(ptr);
+        return still_reachable();
+      }
+    };
+
+    reader_list<reader_record> _readers;
+
+    struct hazard {
+      thread_record& _rec;
+      std::atomic<const void*>& _slot;
+
+      hazard(hazard_reclaimer& reclaimer, const std::size_t tid)
+          : _rec(reclaimer._records[tid]), _slot(claim(_rec)) {
+      }
+
+      hazard(const hazard&) = delete;
+      hazard& operator=(const hazard&) = delete;
+
+      ~hazard(void) {
+        this->_slot.store(nullptr);
+        --this->_rec.depth;
+      }
+
+      template <typename F>
+      bool protect(const void* ptr, F still_reachable) {
+        this->_slot.store(ptr);
+        return still_reachable();
+      }
+
+      static std::atomic<const void*>& claim(thread_record& rec) {
+        if (rec.depth >= MaxHazards) {
+          throw std::runtime_error{"out of hazard pointers"};
+        }
+        return rec.hazards[rec.depth++];
+      }
+    };
+
+    hazard_reclaimer(std::size_t num_threads)
+        : _num_threads(num_threads),
+          _active(num_threads),
+          _records(new thread_record[num_threads]) {
+    }
+
+    hazard_reclaimer(const hazard_reclaimer&) = delete;
+    hazard_reclaimer& operator=(const hazard_reclaimer&) = delete;
+
+    ~hazard_reclaimer(void) {
+      for (std::size_t tid = 0; tid < this->_num_threads; ++tid) {
+        for (const auto& r : this->_records[tid].retired) {
+          r.reclaim(r.ptr, tid);
+        }
+        for (const auto& r : this->_records[tid].retired_arrays) {
+          r.node.reclaim(r.node.ptr, tid);
+        }
+      }
+      delete[] this->_records;
+    }
+
+    void enter(const std::size_t tid) {
+      assert(tid < this->_num_threads);
+
+      // must be visible to scan before we publish any hazard
+      this->_active.add(tid);
+    }
+
+    void release_slot(const std::size_t tid) {
+      this->_active.remove(tid);
+    }
+
+    void leave(const std::size_t tid) {
+      this->_records[tid].generation.store(Unprotected);
+    }
+
+    reader_record* enter_reader(void) {
+      return this->_readers.acquire();
+    }
+
+    void leave_reader(reader_record* const rec) {
+      rec->hazard.store(nullptr);
+      rec->generation.store(Unprotected);
+      this->_readers.release(rec);
+    }
+
+    template <typename F>
+    void protect_generation(const std::size_t tid, F current) {
+      pin_generation(this->_records[tid].generation, current);
+    }
+
+    template <typename F>
+    static void pin_generation(std::atomic<std::size_t>& generation,
+                               F current) {
+      // protect everything while we find out what the current array is;
+      // nothing reachable is ever retired, so it cannot be freed under us
+      generation.store(0);
+      const std::size_t g = current();
+      generation.store(g == 0 ? 0 : g - 1);
+    }
+
+    void retire_generation(const std::size_t tid, const std::size_t generation,
+                           void* ptr, void (*reclaim)(void*, std::size_t)) {
+      thread_record& rec = this->_records[tid];
+      rec.retired_arrays.push_back(
+          retired_storage{retired_node{ptr, reclaim}, generation});
+      this->scan(tid);
+    }
+
+    void retire(const std::size_t tid, void* ptr,
+                void (*reclaim)(void*, std::size_t)) {
+      thread_record& rec = this->_records[tid];
+      rec.retired.push_back(retired_node{ptr, reclaim});
+      bump(rec.backlog);
+
+      if (rec.retired.size() >= ScanEvery) {
+        this->scan(tid);
+      }
+    }
+
+    void scan(const std::size_t tid) {
+      thread_record& rec = this->_records[tid];
+
+      auto& hazards = rec.seen;
+      hazards.clear();
+      this->_active.for_each([&](const std::size_t i) {
+        for (const auto& h : this->_records[i].hazards) {
+          const void* p = h.load();
+          if (p != nullptr) {
+            hazards.push_back(p);
+          }
+        }
+      });
+      this->_readers.for_each([&](const reader_record& r) {
+        const void* p = r.hazard.load();
+        if (p != nullptr) {
+          hazards.push_back(p);
+        }
+      });
+      std::sort(hazards.begin(), hazards.end());
+
+      auto& keep = rec.keep;
+      keep.clear();
+      for (const auto& r : rec.retired) {
+        if (std::binary_search(hazards.begin(), hazards.end(), r.ptr)) {
+          keep.push_back(r);
+        } else {
+          r.reclaim(r.ptr, tid);
+        }
+      }
+      rec.retired.swap(keep);
+      set_stat(rec.backlog, rec.retired.size() + rec.retired_arrays.size());
+
+      if (rec.retired_arrays.empty()) {
+        return;
+      }
+
+      std::size_t oldest = Unprotected;
+      this->_active.for_each([&](const std::size_t i) {
+        oldest = std::min(oldest, this->_records[i].generation.load());
+      });
+      this->_readers.for_each([&](const reader_record& r) {
+        oldest = std::min(oldest, r.generation.load());
+      });
+
+      auto& keep_arrays = rec.keep_arrays;
+      keep_arrays.clear();
+      for (const auto& r : rec.retired_arrays) {
+        if (r.generation >= oldest) {
+          keep_arrays.push_back(r);
+        } else {
+          r.node.reclaim(r.node.ptr, tid);
+        }
+      }
+      rec.retired_arrays.swap(keep_arrays);
+      set_stat(rec.backlog, rec.retired.size() + rec.retired_arrays.size());
+    }
+
+    // released slots included, as their objects wait for the slot's reuse
+    std::size_t backlog(void) const {
+      std::size_t total = 0;
+      for (std::size_t tid = 0; tid < this->_num_threads; ++tid) {
+        total += this->_records[tid].backlog.load();
+      }
+      return total;
+    }
+  };
+
+  // RAII critical section around a single vector operation
+  template <typename Reclaimer>
+  struct critical_section {
+    Reclaimer& _reclaimer;
+    const std::size_t _tid;
+
+    critical_section(Reclaimer& reclaimer, const std::size_t tid)
+        : _reclaimer(reclaimer), _tid(tid) {
+      this->_reclaimer.enter(this->_tid);
+    }
+
+    critical_section(const critical_section&) = delete;
+    critical_section& operator=(const critical_section&) = delete;
+
+    ~critical_section(void) {
+      this->_reclaimer.leave(this->_tid);
+    }
+  };
+
+  // RAII section around a read by a thread without a tid. Storage arrays
+  // and descriptors read inside it are protected the way a thread protects
+  // them, through the section's own reader record.
+  template <typename Reclaimer>
+  struct reader_section {
+    typedef typename Reclaimer::reader_record record;
+
+    Reclaimer& _reclaimer;
+    record* const _rec;
+
+    reader_section(Reclaimer& reclaimer)
+        : _reclaimer(reclaimer), _rec(reclaimer.enter_reader()) {
+    }
+
+    reader_section(const reader_section&) = delete;
+    reader_section& operator=(const reader_section&) = delete;
+
+    ~reader_section(void) {
+      this->_reclaimer.leave_reader(this->_rec);
+    }
+
+    template <typename F>
+    void protect_generation(F current) {
+      this->_rec->protect_generation(current);
+    }
+
+    template <typename F>
+    bool protect(const void* ptr, F still_reachable) {
+      return this->_rec->protect(ptr, still_reachable);
+    }
+  };
+}; // namespace waitfree
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+#include "stats.hpp"
+
+namespace waitfree {
+
+  // Storage that never moves. The whole address range for MaxElements slots
+  // is reserved up front with PROT_NONE and pages are made writable as the
+  // capacity grows, so a resize commits pages instead of copying every slot
+  // into a new array. Fresh pages read as zero, which is NotValue, so nothing
+  // has to be filled in either.
+  //
+  // Exposes the same interface the vector uses on Contiguous; resize() always
+  // returns the same object and the generation never changes.
+  template <typename V, std::size_t MaxElements>
+  struct Reserved {
+    typedef typename V::slot_type T;
+
+    static const bool Replaceable = false;
+    // the last slot is kept free for a pop, which works on the slot past
+    // the last element
+    static const std::size_t MaxSize = MaxElements - 1;
+
+    V* vec;
+    std::atomic<std::size_t> capacity;
+    const std::size_t generation;
+
+    const std::size_t page_size;
+    std::atomic<T*>* array;
+
+    Reserved(V* vec, Reserved*, std::size_t capacity)
+        : vec(vec),
+          capacity(0),
+          generation(0),
+          page_size(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))),
+          array(nullptr) {
+      void* base = mmap(nullptr, MaxElements * sizeof(std::atomic<T*>),
+                        PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                        -1, 0);
+      if (base == MAP_FAILED) {
+        throw std::runtime_error{"could not reserve storage"};
+      }
+      this->array = static_cast<std::atomic<T*>*>(base);
+
+      this->commit(capacity);
+      this->capacity.store(capacity);
+    }
+
+    Reserved(const Reserved&) = delete;
+    Reserved& operator=(const Reserved&) = delete;
+
+    ~Reserved(void) {
+      munmap(this->array, MaxElements * sizeof(std::atomic<T*>));
+    }
+
+    // Grows the committed prefix by the vector's growth policy, or to
+    // `at_least` slots if that is more.
+    Reserved* resize(const std::size_t tid, const std::size_t at_least = 0) {
+      std::size_t current = this->capacity.load();
+      const std::size_t wanted = std::min(
+          std::max(V::growth_policy::grow(current), at_least), MaxElements);
+      if (wanted <= current) {
+        throw std::runtime_error{"reserved storage is full"};
+      }
+
+      // committing pages that are already writable is harmless, so racing
+      // resizers need not agree on who does it; the first to publish wins
+      this->commit(wanted);
+      if (this->capacity.compare_exchange_strong(current, wanted)) {
+        bump(this->vec->counters(tid).resizes);
+      }
+      return this;
+    }
+
+    std::size_t chain_depth(void) const {
+      return 1;
+    }
+
+    std::atomic<T*>& getSpot(const std::size_t tid, const std::size_t pos) {
+      if (pos >= this->capacity.load()) {
+        return this->resize(tid)->getSpot(tid, pos);
+      }
+
+      return this->array[pos];
+    }
+
+    // the value at `pos` without writing anything; NotValue past the end
+    T* peek(const std::size_t pos) {
+      if (pos >= this->capacity.load()) {
+        return nullptr;
+      }
+      return this->array[pos].load();
+    }
+
+    // makes the first n slots, rounded up to whole pages, writable
+    void commit(const std::size_t n) {
+      const std::size_t bytes = n * sizeof(std::atomic<T*>);
+      const std::size_t rounded =
+          (bytes + this->page_size - 1) / this->page_size * this->page_size;
+      if (rounded != 0 &&
+          mprotect(this->array, rounded, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error{"could not commit storage"};
+      }
+    }
+  };
+
+  // Storage policy selecting Reserved; MaxElements bounds the size of the
+  // vector for good, and the default reserves 1 GiB of address space.
+  template <std::size_t MaxElements = (std::size_t{1} << 27)>
+  struct reserved_storage {
+    template <typename V>
+    using type = Reserved<V, MaxElements>;
+  };
+}; // namespace waitfree
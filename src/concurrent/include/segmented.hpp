@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "reclamation.hpp"
+#include "stats.hpp"
+
+namespace waitfree {
+
+  // Storage made of buckets that double in size, as in Dechev et al.: bucket
+  // b holds FirstBucket << b slots, so position pos lives in bucket
+  // msb(pos + FirstBucket) - log2(FirstBucket). Growing allocates the next
+  // bucket and nothing is ever copied or moved; the price is that the slots
+  // are not contiguous.
+  //
+  // Buckets always double, so the vector's growth policy does not apply.
+  // Exposes the same interface the vector uses on Contiguous; resize() always
+  // returns the same object and the generation never changes.
+  template <typename V, std::size_t FirstBucket>
+  struct Segmented {
+    static_assert(FirstBucket != 0 && (FirstBucket & (FirstBucket - 1)) == 0,
+                  "the first bucket must be a power of two");
+
+    typedef typename V::slot_type T;
+
+    static const unsigned FirstBit = __builtin_ctzll(FirstBucket);
+    static const std::size_t NumBuckets = 64 - FirstBit;
+    // resize() keeps this object, and it grows until memory runs out
+    static const bool Replaceable = false;
+    static const std::size_t MaxSize = std::numeric_limits<std::size_t>::max();
+
+    V* vec;
+    // slots in the buckets allocated so far, which are always a prefix
+    std::atomic<std::size_t> capacity;
+    const std::size_t generation;
+
+    std::atomic<std::atomic<T*>*> buckets[NumBuckets];
+
+    Segmented(V* vec, Segmented*, std::size_t capacity)
+        : vec(vec), capacity(0), generation(0) {
+      for (auto& bucket : this->buckets) {
+        bucket.store(nullptr);
+      }
+      this->grow(capacity);
+    }
+
+    Segmented(const Segmented&) = delete;
+    Segmented& operator=(const Segmented&) = delete;
+
+    ~Segmented(void) {
+      for (auto& bucket : this->buckets) {
+        delete[] bucket.load();
+      }
+    }
+
+    static unsigned msb(const std::uint64_t x) {
+      return 63 - __builtin_clzll(x);
+    }
+
+    // the bucket holding position pos
+    static std::size_t bucket_of(const std::size_t pos) {
+      return msb(pos + FirstBucket) - FirstBit;
+    }
+
+    // one past the last position of bucket b
+    static std::size_t bucket_end(const std::size_t b) {
+      return (FirstBucket << (b + 1)) - FirstBucket;
+    }
+
+    // Allocates the next bucket, and more until there are at least
+    // `at_least` slots.
+    Segmented* resize(const std::size_t tid, const std::size_t at_least = 0) {
+      bump(this->vec->counters(tid).resizes, this->grow(at_least));
+      return this;
+    }
+
+    std::size_t chain_depth(void) const {
+      return 1;
+    }
+
+    // resize() without the bookkeeping; returns how many buckets this call
+    // allocated
+    std::size_t grow(const std::size_t at_least) {
+      std::size_t allocated = 0;
+      const std::size_t current = this->capacity.load();
+      const std::size_t wanted = std::max(current + 1, at_least);
+
+      std::size_t b = current == 0 ? 0 : bucket_of(current - 1) + 1;
+      for (; b <= bucket_of(wanted - 1); ++b) {
+        if (this->buckets[b].load() != nullptr) {
+          continue;
+        }
+        // fresh slots are NotValue
+        auto bucket = new std::atomic<T*>[FirstBucket << b]();
+        std::atomic<T*>* expected = nullptr;
+        if (this->buckets[b].compare_exchange_strong(expected, bucket)) {
+          ++allocated;
+        } else {
+          delete[] bucket;
+        }
+      }
+
+      atomic_max(this->capacity, bucket_end(b - 1));
+      return allocated;
+    }
+
+    std::atomic<T*>& getSpot(const std::size_t tid, const std::size_t pos) {
+      if (pos >= this->capacity.load()) {
+        this->resize(tid, pos + 1);
+      }
+
+      const std::size_t b = bucket_of(pos);
+      const std::size_t offset =
+          (pos + FirstBucket) ^ (std::size_t{1} << (b + FirstBit));
+      return this->buckets[b].load()[offset];
+    }
+
+    // the value at `pos` without writing anything; NotValue past the end
+    T* peek(const std::size_t pos) {
+      if (pos >= this->capacity.load()) {
+        return nullptr;
+      }
+
+      const std::size_t b = bucket_of(pos);
+      const std::size_t offset =
+          (pos + FirstBucket) ^ (std::size_t{1} << (b + FirstBit));
+      return this->buckets[b].load()[offset].load();
+    }
+  };
+
+  // Storage policy selecting Segmented, with a first bucket of FirstBucket
+  // slots.
+  template <std::size_t FirstBucket = 8>
+  struct segmented_storage {
+    template <typename V>
+    using type = Segmented<V, FirstBucket>;
+  };
+}; // namespace waitfree
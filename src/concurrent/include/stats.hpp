@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace waitfree {
+
+  // Instrumentation. Build with -DWAITFREE_NO_STATS to leave it out; every
+  // counter update is then a branch on a constant false and compiles away.
+#ifdef WAITFREE_NO_STATS
+  const bool StatsEnabled = false;
+#else
+  const bool StatsEnabled = true;
+#endif
+
+  typedef std::atomic<std::size_t> stat_counter;
+
+  // Only the owning thread ever writes a counter, so a plain load and store
+  // is enough; they are atomic so that a snapshot may read them meanwhile.
+  inline void bump(stat_counter& counter, const std::size_t by = 1) {
+    if (StatsEnabled) {
+      counter.store(counter.load(std::memory_order_relaxed) + by,
+                    std::memory_order_relaxed);
+    }
+  }
+
+  inline void set_stat(stat_counter& counter, const std::size_t value) {
+    if (StatsEnabled) {
+      counter.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // What vector::stats() reports: the per-thread counters summed, plus the
+  // state of the storage and the reclaimer at the time of the call.
+  struct vector_stats {
+    std::size_t operations;
+    std::size_t announced;
+    std::size_t helped;
+    std::size_t cas_failures;
+    std::size_t resizes;
+
+    // thread slots in use: registered, or used and not yet released
+    std::size_t live_threads;
+    // storage arrays still reachable; 2 while a resize is being copied
+    std::size_t storage_chain;
+    // generation of the current storage array; only Contiguous ever
+    // replaces its array
+    std::size_t storage_generation;
+    // objects retired but not yet freed, across all threads
+    std::size_t retired_backlog;
+
+    // operations that completed without announcing
+    std::size_t fast_path(void) const {
+      return this->operations - this->announced;
+    }
+  };
+}; // namespace waitfree
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace waitfree {
+
+  // How elements are kept in the vector's slots. Every slot is a single
+  // std::atomic<slot_type*>; its two low bits are stolen for IsDescriptor and
+  // Resize, and a null word means "no value".
+  //
+  // By default the vector stores pointers the caller owns: waitfree::vector<T>
+  // takes and returns T*.
+  template <typename T>
+  struct value_codec {
+    typedef T slot_type;
+    typedef T* element_type;
+
+    static T* encode(T* const element) {
+      return element;
+    }
+
+    static T* decode(T* const word) {
+      return word;
+    }
+  };
+
+  // Selects inline storage: waitfree::vector<inline_value<U>> keeps each U in
+  // the slot word itself instead of behind a pointer, so an element costs one
+  // word and reading it touches no other memory.
+  template <typename U>
+  struct inline_value;
+
+  // never dereferenced; encoded words are only ever compared and copied
+  struct alignas(8) inline_slot {};
+
+  // A value is stored as (bits << 3) | 0b100: bit 2 keeps the word non-null
+  // and bits 0-1 stay free for the descriptor/resize marks. That leaves 61
+  // bits of payload. Only integers and enums are accepted: they convert to
+  // a 64-bit integer and back exactly, signed ones sign-extended, so the
+  // range check in encode() is all it takes to keep them lossless.
+  template <typename U>
+  struct value_codec<inline_value<U>> {
+    static_assert(std::is_integral<U>::value || std::is_enum<U>::value,
+                  "inline values must be integers or enums");
+    static_assert(sizeof(U) <= sizeof(std::uint64_t),
+                  "inline values must fit in a word");
+    static_assert(sizeof(inline_slot*) == sizeof(std::uint64_t),
+                  "inline values need 64-bit slots");
+
+    typedef inline_slot slot_type;
+    typedef U element_type;
+
+    static const unsigned Shift = 3;
+    static const std::uint64_t Present = 0b100;
+
+    static inline_slot* encode(const U element) {
+      const std::int64_t bits = static_cast<std::int64_t>(element);
+      const std::uint64_t word =
+          (static_cast<std::uint64_t>(bits) << Shift) | Present;
+
+      if ((static_cast<std::int64_t>(word) >> Shift) != bits) {
+        throw std::runtime_error{"value too wide to be stored inline"};
+      }
+
+      return reinterpret_cast<inline_slot*>(word);
+    }
+
+    static U decode(inline_slot* const word) {
+      if (word == nullptr) {
+        return U{};
+      }
+
+      const std::int64_t bits =
+          static_cast<std::int64_t>(reinterpret_cast<std::uint64_t>(word)) >>
+          Shift;
+      return static_cast<U>(bits);
+    }
+  };
+}; // namespace waitfree
@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <random>
+#include <set>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "include/append_only.hpp"
 #include "include/vector.hpp"
 
 void test_pushback(const int NUM_THREADS) {
@@ -132,6 +140,746 @@ void test_cwrite(const int NUM_THREADS) {
   std::cout << "\n";
 }
 
+// Shifts from every thread at once, single and ranged, with pushes running
+// into the end of the chains. Every element is a distinct pointer, so a
+// shift that loses or repeats one shows up as a hole or a duplicate.
+template <typename Vector>
+void test_shift(const int NUM_THREADS, const std::size_t HELP_EVERY = 1,
+                const unsigned MAX_BACKOFF = 0) {
+  const int LEN = 50;
+  const int OPS = 400;
+
+  std::cout << "TEST SHIFT " << NUM_THREADS << " threads help every "
+            << HELP_EVERY << " backoff " << MAX_BACKOFF << "\n";
+  Vector vec(NUM_THREADS, 0, HELP_EVERY, MAX_BACKOFF);
+  for (int i = 0; i < LEN; ++i) {
+    vec.wf_push_back(0, new int{i});
+  }
+
+  std::vector<long> net(NUM_THREADS);
+
+  auto go = [&](int id) {
+    std::mt19937 r(id);
+    for (int i = 0; i < OPS; ++i) {
+      const std::size_t size = vec.size();
+      const int op = r() % 5;
+      if (op == 0 || size == 0) {
+        vec.wf_push_back(id, new int{i});
+        ++net[id];
+      } else if (op == 1) {
+        net[id] += vec.insertAt(id, r() % size, new int{i});
+      } else if (op == 2) {
+        net[id] -= vec.eraseAt(id, r() % size);
+      } else if (op == 3) {
+        std::vector<int*> vals{new int{i}, new int{i}, new int{i}};
+        if (vec.insertRange(id, r() % size, vals.begin(), vals.end())) {
+          net[id] += 3;
+        }
+      } else if (vec.eraseRange(id, r() % size, 2)) {
+        net[id] -= 2;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  long expected = LEN;
+  for (long n : net) {
+    expected += n;
+  }
+
+  std::set<int*> seen;
+  int holes = 0, dups = 0;
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    auto elem = vec.at(0, i);
+    if (!elem.first) {
+      ++holes;
+    } else if (!seen.insert(elem.second).second) {
+      ++dups;
+    }
+  }
+
+  std::cout << "size " << vec.size() << " expected " << expected << " holes "
+            << holes << " duplicates " << dups << "\n";
+  assert(static_cast<long>(vec.size()) == expected);
+  assert(holes == 0 && dups == 0);
+  assert(!vec.at(0, vec.size()).first);
+  // every announcement was seen through and cleared
+  assert(vec._pending.load() == 0);
+}
+
+// Pushes and pops racing on the tail. Every value pushed is either popped
+// exactly once or still in the vector at the end.
+template <typename Vector>
+void test_push_pop(const int NUM_THREADS, const std::size_t HELP_EVERY = 1,
+                   const unsigned MAX_BACKOFF = 0) {
+  const int OPS = 4000;
+
+  std::cout << "TEST PUSH POP " << NUM_THREADS << " threads help every "
+            << HELP_EVERY << " backoff " << MAX_BACKOFF << "\n";
+  Vector vec(NUM_THREADS, 0, HELP_EVERY, MAX_BACKOFF);
+  std::vector<std::vector<int*>> pushed(NUM_THREADS), popped(NUM_THREADS);
+
+  auto go = [&](int id) {
+    std::mt19937 r(id);
+    for (int i = 0; i < OPS; ++i) {
+      if (r() % 3 != 0) {
+        int* const val = new int{i};
+        vec.wf_push_back(id, val);
+        pushed[id].push_back(val);
+      } else {
+        auto elem = vec.wf_popback(id);
+        if (elem.first) {
+          popped[id].push_back(elem.second);
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::set<int*> all, out;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    all.insert(pushed[i].begin(), pushed[i].end());
+    for (int* p : popped[i]) {
+      assert(out.insert(p).second);
+    }
+  }
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    auto elem = vec.at(0, i);
+    assert(elem.first);
+    assert(out.insert(elem.second).second);
+  }
+
+  std::cout << "size " << vec.size() << " announced "
+            << vec.stats().announced << "\n";
+  assert(out == all);
+  assert(vec._pending.load() == 0);
+  for (int* p : all) {
+    delete p;
+  }
+}
+
+// A tid out of range throws before the operation touches anything, and a
+// table fixed at compile time takes no more threads than it has slots.
+template <typename Reclaimer>
+void test_tid(void) {
+  std::cout << "TEST TID\n";
+  waitfree::vector<int, Reclaimer> vec(2);
+  int* const val = new int{1};
+  for (int op = 0; op < 3; ++op) {
+    bool threw = false;
+    try {
+      if (op == 0) {
+        vec.wf_push_back(2, val);
+      } else if (op == 1) {
+        vec.at(2, 0);
+      } else {
+        vec.stats(2);
+      }
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    assert(threw);
+  }
+  vec.wf_push_back(1, val);
+  assert(vec.at(0, 0) == std::make_pair(true, val));
+  delete val;
+
+  typedef waitfree::vector<int, Reclaimer, growth::doubling,
+                           waitfree::contiguous_storage, 4>
+      fixed;
+  bool threw = false;
+  try {
+    fixed too_many(5);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  assert(threw);
+  test_push_pop<fixed>(4);
+}
+
+// Threads that claim a slot with register_thread(), push and give it back.
+// A released slot leaves the set that helping and scans visit, and is the
+// first one handed out again.
+template <typename Reclaimer>
+void test_register(const int NUM_THREADS) {
+  const int ROUNDS = 50;
+
+  std::cout << "TEST REGISTER " << NUM_THREADS << " threads\n";
+  waitfree::vector<int, Reclaimer> vec(NUM_THREADS);
+  {
+    auto a = vec.register_thread();
+    auto b = vec.register_thread();
+    assert(a.tid() == 0 && b.tid() == 1);
+    assert(vec.stats().live_threads == 2);
+    {
+      auto c = vec.register_thread();
+      assert(c.tid() == 2);
+      vec.wf_push_back(c.tid(), new int{2});
+      assert(vec.stats().live_threads == 3);
+    }
+    assert(vec.stats().live_threads == 2);
+    auto d = vec.register_thread();
+    assert(d.tid() == 2);
+  }
+  assert(vec.stats().live_threads == 0);
+
+  auto go = [&](int id) {
+    for (int i = 0; i < ROUNDS; ++i) {
+      auto reg = vec.register_thread();
+      vec.wf_push_back(reg.tid(), new int{id});
+      if (i % 2 == 0) {
+        delete vec.wf_popback(reg.tid()).second;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::cout << "size " << vec.size() << "\n";
+  assert(vec.stats().live_threads == 0);
+  assert(vec.size() == 1 + std::size_t(NUM_THREADS) * ROUNDS / 2);
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    delete vec.at(0, i).second;
+  }
+}
+
+// Blocks appended with push_back_range() racing single pushes. Every block
+// lands whole and in order at the index it returned.
+template <typename Reclaimer>
+void test_push_range(const int NUM_THREADS) {
+  const int BLOCKS = 300;
+  const int LEN = 5;
+
+  std::cout << "TEST PUSH RANGE " << NUM_THREADS << " threads\n";
+  waitfree::vector<int, Reclaimer> vec(NUM_THREADS);
+  std::vector<std::vector<std::pair<std::size_t, std::vector<int*>>>> blocks(
+      NUM_THREADS);
+
+  auto go = [&](int id) {
+    for (int b = 0; b < BLOCKS; ++b) {
+      std::vector<int*> vals;
+      for (int j = 0; j < LEN; ++j) {
+        vals.push_back(new int{id});
+      }
+      const std::size_t pos = vec.push_back_range(id, vals.begin(), vals.end());
+      blocks[id].emplace_back(pos, vals);
+      vec.wf_push_back(id, new int{id});
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::cout << "size " << vec.size() << "\n";
+  assert(vec.size() == std::size_t(NUM_THREADS) * BLOCKS * (LEN + 1));
+  for (const auto& mine : blocks) {
+    for (const auto& block : mine) {
+      for (int j = 0; j < LEN; ++j) {
+        assert(vec.at(0, block.first + j).second == block.second[j]);
+      }
+    }
+  }
+
+  std::vector<int*> none;
+  assert(vec.push_back_range(0, none.begin(), none.end()) == vec.size());
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    delete vec.at(0, i).second;
+  }
+}
+
+// Threads pushing past many resizes, one of them reserving room as it
+// goes. Every value is in the vector once, and each thread's values are
+// in the order it pushed them.
+template <typename Vector>
+void test_grow(const std::string& name, const int NUM_THREADS,
+               const int PER_THREAD) {
+  std::cout << "TEST GROW " << name << " " << NUM_THREADS << " threads\n";
+  Vector vec(NUM_THREADS);
+
+  auto go = [&](int id) {
+    for (int i = 0; i < PER_THREAD; ++i) {
+      if (id == 0 && i % 500 == 0) {
+        vec.reserve(id, vec.size() + 1000);
+      }
+      vec.wf_push_back(id, new int{id * PER_THREAD + i});
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::vector<int> last(NUM_THREADS, -1);
+  std::set<int> seen;
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    auto elem = vec.at(0, i);
+    assert(elem.first);
+    const int v = *elem.second;
+    assert(seen.insert(v).second);
+    assert(v > last[v / PER_THREAD]);
+    last[v / PER_THREAD] = v;
+    delete elem.second;
+  }
+  std::cout << "size " << vec.size() << " capacity " << vec.capacity()
+            << " resizes " << vec.stats().resizes << "\n";
+  assert(seen.size() == std::size_t(NUM_THREADS) * PER_THREAD);
+  // every copy was finished and the old arrays unlinked
+  assert(vec.stats().storage_chain == 1);
+}
+
+// reserve() grows the storage once, after which filling it up to the
+// reserved size never resizes, whatever the growth policy.
+template <typename Vector>
+void test_reserve(const std::string& name) {
+  const std::size_t N = 5000;
+
+  std::cout << "TEST RESERVE " << name << "\n";
+  Vector vec(1);
+  vec.reserve(0, N);
+  assert(vec.capacity() >= N);
+  const std::size_t capacity = vec.capacity();
+  const std::size_t resizes = vec.stats().resizes;
+  assert(resizes == 1);
+
+  int* const val = new int{1};
+  for (std::size_t i = 0; i < N; ++i) {
+    vec.wf_push_back(0, val);
+  }
+  vec.reserve(0, N / 2);
+  assert(vec.capacity() == capacity);
+  assert(vec.stats().resizes == resizes);
+  delete val;
+}
+
+// A vector whose storage has a fixed maximum, filled up to it. Pushing
+// past it throws and inserting fails, both without changing anything, and
+// popping makes room again.
+template <typename Vector>
+void test_full(const std::string& name) {
+  const std::size_t MAX = Vector::storage_type::MaxSize;
+
+  std::cout << "TEST FULL " << name << " " << MAX << "\n";
+  Vector vec(1);
+  int* const val = new int{1};
+  for (std::size_t i = 0; i < MAX; ++i) {
+    assert(vec.wf_push_back(0, val) == i);
+  }
+
+  bool threw = false;
+  try {
+    vec.wf_push_back(0, val);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  assert(threw);
+  assert(!vec.insertAt(0, 0, val));
+  assert(vec.size() == MAX);
+  assert(!vec.at(0, MAX).first);
+
+  assert(vec.wf_popback(0) == std::make_pair(true, val));
+  assert(vec.insertAt(0, 0, val));
+  assert(vec.size() == MAX);
+  delete val;
+}
+
+// The counters against operations whose outcome is known: every call
+// counts once, a lone thread never announces, and a contiguous vector
+// bumps its generation on each resize.
+template <typename Reclaimer>
+void test_stats(const int NUM_THREADS) {
+  const int OPS = 1000;
+
+  std::cout << "TEST STATS " << NUM_THREADS << " threads\n";
+  waitfree::vector<int, Reclaimer> vec(NUM_THREADS);
+  int* const val = new int{1};
+
+  std::size_t resizes = 0;
+  for (int i = 0; i < OPS; ++i) {
+    const std::size_t capacity = vec.capacity();
+    vec.wf_push_back(0, val);
+    resizes += vec.capacity() != capacity;
+  }
+  for (int i = 0; i < OPS / 2; ++i) {
+    vec.wf_popback(0);
+  }
+
+  auto snapshot = vec.stats();
+  assert(vec.stats(0).operations.load() == OPS + OPS / 2);
+  assert(snapshot.operations == OPS + OPS / 2);
+  assert(snapshot.announced == 0 && snapshot.helped == 0);
+  assert(snapshot.fast_path() == snapshot.operations);
+  assert(snapshot.cas_failures == 0);
+  assert(snapshot.resizes == resizes);
+  assert(snapshot.storage_generation == resizes);
+  assert(snapshot.storage_chain == 1);
+  assert(snapshot.live_threads == 1);
+
+  auto go = [&](int id) {
+    for (int i = 0; i < OPS; ++i) {
+      vec.wf_push_back(id, val);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  snapshot = vec.stats();
+  std::cout << "operations " << snapshot.operations << " announced "
+            << snapshot.announced << " helped " << snapshot.helped
+            << " cas failures " << snapshot.cas_failures << " resizes "
+            << snapshot.resizes << "\n";
+  assert(snapshot.operations ==
+         OPS + OPS / 2 + std::size_t(NUM_THREADS - 1) * OPS);
+  assert(snapshot.live_threads == std::size_t(NUM_THREADS));
+  for (int i = 1; i < NUM_THREADS; ++i) {
+    assert(vec.stats(i).operations.load() == std::size_t(OPS));
+  }
+  delete val;
+}
+
+// A thread's retry limit doubles back up to LIMIT after every
+// RAISE_LIMIT_EVERY operations it starts, however low it was.
+template <typename Reclaimer>
+void test_retry_limit(void) {
+  std::cout << "TEST RETRY LIMIT\n";
+  waitfree::vector<int, Reclaimer> vec(1);
+  int* const val = new int{1};
+
+  vec._threads[0].retry_limit = waitfree::MIN_LIMIT;
+  vec._threads[0].since_limit = 0;
+  int expected = waitfree::MIN_LIMIT;
+  for (int round = 0; round < 10; ++round) {
+    for (std::size_t i = 0; i < waitfree::RAISE_LIMIT_EVERY; ++i) {
+      assert(vec.retry_limit(0) == expected);
+      vec.wf_push_back(0, val);
+    }
+    expected = std::min(waitfree::LIMIT, expected * 2);
+    assert(vec.retry_limit(0) == expected);
+  }
+  assert(expected == waitfree::LIMIT);
+  delete val;
+}
+
+// Registered threads appending past many resizes while a reader watches.
+// Every index handed out is distinct and holds the value pushed there.
+template <typename Reclaimer>
+void test_append_only(const int NUM_THREADS) {
+  const int PER_THREAD = 5000;
+
+  std::cout << "TEST APPEND ONLY " << NUM_THREADS << " threads\n";
+  waitfree::append_only_vector<int, Reclaimer> vec(NUM_THREADS);
+  std::vector<std::vector<std::pair<std::size_t, int*>>> pushed(NUM_THREADS);
+
+  std::atomic_bool done(false);
+  std::thread reader([&] {
+    std::mt19937 r(0);
+    while (!done.load()) {
+      const std::size_t size = vec.size();
+      auto elem = vec.read(r() % (size + 1));
+      assert(!elem.first || *elem.second < NUM_THREADS);
+    }
+  });
+
+  auto go = [&](int) {
+    auto reg = vec.register_thread();
+    for (int i = 0; i < PER_THREAD; ++i) {
+      int* const val = new int{int(reg.tid())};
+      pushed[reg.tid()].emplace_back(vec.push_back(reg.tid(), val), val);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back(go, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  done.store(true);
+  reader.join();
+
+  std::cout << "size " << vec.size() << " capacity " << vec.capacity()
+            << "\n";
+  assert(vec.size() == std::size_t(NUM_THREADS) * PER_THREAD);
+  std::set<std::size_t> indices;
+  for (const auto& mine : pushed) {
+    for (const auto& p : mine) {
+      assert(indices.insert(p.first).second);
+      assert(vec.at(0, p.first) == std::make_pair(true, p.second));
+      delete p.second;
+    }
+  }
+  assert(!vec.at(0, vec.size()).first);
+
+  waitfree::append_only_vector<waitfree::inline_value<long>, Reclaimer> ids(1);
+  ids.reserve(0, 100);
+  const std::size_t capacity = ids.capacity();
+  for (long i = 0; i < 100; ++i) {
+    assert(ids.push_back(0, -i) == std::size_t(i));
+  }
+  assert(ids.capacity() == capacity);
+  assert(ids.read(99) == std::make_pair(true, -99L));
+}
+
+// Ranged inserts and erases on one thread, checked against std::vector. An
+// erase of more elements than there are past pos, however many, fails and
+// leaves the vector as it was.
+template <typename Reclaimer>
+void test_range(void) {
+  const int OPS = 2000;
+
+  std::cout << "TEST RANGE\n";
+  waitfree::vector<int, Reclaimer> vec(1);
+  std::vector<int*> ref;
+  for (int i = 0; i < 5; ++i) {
+    ref.push_back(new int{i});
+    vec.wf_push_back(0, ref.back());
+  }
+
+  assert(!vec.eraseRange(0, 1, std::numeric_limits<std::size_t>::max()));
+  assert(!vec.eraseRange(0, 3, 3));
+  assert(!vec.eraseRange(0, 5, 1));
+  assert(vec.size() == ref.size());
+
+  std::mt19937 r(1);
+  for (int i = 0; i < OPS; ++i) {
+    if (ref.empty()) {
+      ref.push_back(new int{i});
+      vec.wf_push_back(0, ref.back());
+    }
+
+    const std::size_t size = ref.size();
+    const std::size_t pos = r() % (size + 1);
+    const std::size_t count = r() % 4 + 1;
+    if (r() % 2 == 0) {
+      std::vector<int*> vals;
+      for (std::size_t j = 0; j < count; ++j) {
+        vals.push_back(new int{i});
+      }
+      const bool fits = pos < size;
+      assert(vec.insertRange(0, pos, vals.begin(), vals.end()) == fits);
+      if (fits) {
+        ref.insert(ref.begin() + pos, vals.begin(), vals.end());
+      }
+    } else {
+      const bool fits = pos < size && count <= size - pos;
+      assert(vec.eraseRange(0, pos, count) == fits);
+      if (fits) {
+        ref.erase(ref.begin() + pos, ref.begin() + pos + count);
+      }
+    }
+    assert(vec.size() == ref.size());
+  }
+
+  for (std::size_t i = 0; i < ref.size(); ++i) {
+    assert(vec.at(0, i).second == ref[i]);
+  }
+  assert(!vec.at(0, ref.size()).first);
+  std::cout << "size " << vec.size() << "\n";
+}
+
+// Values kept in the slots themselves, up to the widest that fits in the
+// 61 bits left beside the marks, negative ones included.
+template <typename Reclaimer>
+void test_inline(void) {
+  const long MAX = (1L << 60) - 1;
+  const long MIN = -(1L << 60);
+
+  std::cout << "TEST INLINE\n";
+  waitfree::vector<waitfree::inline_value<long>, Reclaimer> vec(1);
+  const std::vector<long> vals{0, 1, -1, 42, -42, MAX, MIN, MAX - 1, MIN + 1};
+  for (long v : vals) {
+    vec.wf_push_back(0, v);
+  }
+  for (std::size_t i = 0; i < vals.size(); ++i) {
+    assert(vec.at(0, i) == std::make_pair(true, vals[i]));
+    assert(vec.read(i) == std::make_pair(true, vals[i]));
+  }
+
+  for (long v : {MAX + 1, MIN - 1, std::numeric_limits<long>::max(),
+                 std::numeric_limits<long>::min()}) {
+    bool threw = false;
+    try {
+      vec.wf_push_back(0, v);
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    assert(threw);
+  }
+  assert(vec.size() == vals.size());
+
+  assert(vec.cwrite(0, 5, MAX, MIN) == std::make_pair(true, MAX));
+  assert(vec.cwrite(0, 5, MAX, 7) == std::make_pair(false, MIN));
+  assert(vec.cwrite(0, 4, -42, -7).first);
+  assert(vec.insertAt(0, 0, -3));
+  assert(vec.at(0, 0) == std::make_pair(true, -3L));
+  assert(vec.at(0, 5) == std::make_pair(true, -7L));
+  assert(vec.at(0, 6) == std::make_pair(true, MIN));
+  assert(vec.eraseAt(0, 0));
+
+  assert(vec.wf_popback(0) == std::make_pair(true, MIN + 1));
+  assert(vec.wf_popback(0) == std::make_pair(true, MAX - 1));
+  assert(vec.wf_popback(0) == std::make_pair(true, MIN));
+  assert(vec.wf_popback(0) == std::make_pair(true, MIN));
+  for (std::size_t i = vec.size(); i > 0; --i) {
+    assert(vec.wf_popback(0).first);
+  }
+  assert(!vec.wf_popback(0).first);
+
+  enum class color : unsigned char { red, green, blue };
+  waitfree::vector<waitfree::inline_value<color>, Reclaimer> colors(1);
+  colors.wf_push_back(0, color::blue);
+  colors.wf_push_back(0, color::red);
+  assert(colors.at(0, 0) == std::make_pair(true, color::blue));
+  assert(colors.wf_popback(0) == std::make_pair(true, color::red));
+
+  waitfree::vector<waitfree::inline_value<std::uint32_t>, Reclaimer> wide(1);
+  wide.wf_push_back(0, std::numeric_limits<std::uint32_t>::max());
+  assert(wide.read(0).second == std::numeric_limits<std::uint32_t>::max());
+}
+
+// Threads without a tid reading while others push, pop, shift and write.
+// Every element comes from `pool`, so a read either fails or finds one of
+// them.
+template <typename Vector>
+void test_read(const int NUM_THREADS, const int NUM_READERS) {
+  const int LEN = 64;
+  const int OPS = 2000;
+
+  std::cout << "TEST READ " << NUM_THREADS << " threads " << NUM_READERS
+            << " readers\n";
+  std::vector<int*> pool;
+  for (int i = 0; i < 16; ++i) {
+    pool.push_back(new int{i});
+  }
+  const std::set<int*> known(pool.begin(), pool.end());
+
+  Vector vec(NUM_THREADS);
+  for (int i = 0; i < LEN; ++i) {
+    vec.wf_push_back(0, pool[i % pool.size()]);
+  }
+
+  std::atomic_bool done(false);
+  std::atomic<long> found(0);
+  auto read = [&](int id) {
+    std::mt19937 r(id);
+    long n = 0;
+    while (!done.load()) {
+      const std::size_t size = vec.size();
+      auto elem = vec.read(r() % (size + 1));
+      if (elem.first) {
+        assert(known.count(elem.second) == 1);
+        assert(*elem.second >= 0 && *elem.second < 16);
+        ++n;
+      }
+    }
+    found += n;
+  };
+
+  auto write = [&](int id) {
+    std::mt19937 r(id);
+    for (int i = 0; i < OPS; ++i) {
+      int* const val = pool[r() % pool.size()];
+      const std::size_t size = vec.size();
+      const int op = r() % 5;
+      if (op == 0 || size == 0) {
+        vec.wf_push_back(id, val);
+      } else if (op == 1) {
+        vec.wf_popback(id);
+      } else if (op == 2) {
+        vec.insertAt(id, r() % size, val);
+      } else if (op == 3) {
+        vec.eraseAt(id, r() % size);
+      } else {
+        const std::size_t pos = r() % size;
+        vec.cwrite(id, pos, vec.at(id, pos).second, val);
+      }
+    }
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < NUM_READERS; ++i) {
+    readers.emplace_back(read, NUM_THREADS + i);
+  }
+  std::vector<std::thread> writers;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    writers.emplace_back(write, i);
+  }
+  for (auto& t : writers) {
+    t.join();
+  }
+  done.store(true);
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  std::cout << "size " << vec.size() << " reads " << found.load() << "\n";
+  for (int* p : pool) {
+    delete p;
+  }
+}
+
+// A reader stalled inside read() holds back only the descriptor it reads
+// through, so with hazard pointers the garbage stays bounded while it
+// waits. The stall is simulated by holding a reader section open.
+void test_stalled_reader(void) {
+  const int OPS = 20000;
+
+  std::cout << "TEST STALLED READER\n";
+  waitfree::vector<int, waitfree::hazard_reclaimer> vec(1);
+  for (int i = 0; i < 16; ++i) {
+    vec.wf_push_back(0, new int{i});
+  }
+
+  std::size_t most = 0;
+  {
+    waitfree::reader_section<waitfree::hazard_reclaimer> stalled(
+        vec._reclaimer);
+    for (int i = 0; i < OPS; ++i) {
+      vec.insertAt(0, i % 8, new int{i});
+      vec.eraseAt(0, i % 8);
+      most = std::max(most, vec.stats().retired_backlog);
+    }
+  }
+
+  std::cout << "most retired " << most << "\n";
+  assert(most < 4 * waitfree::hazard_reclaimer::ScanEvery);
+}
+
+template <typename Reclaimer>
 void test_all(int MAX_NUM_THREADS) {
   const int MAX_OPS = 6400;
   const int INSERT = 0, ERASE = 1;
@@ -142,7 +890,7 @@ void test_all(int MAX_NUM_THREADS) {
     std::cout << num_threads;
 
     for(int type : {INSERT, ERASE}) {
-      waitfree::vector<int> vec(num_threads + 1);
+      waitfree::vector<int, Reclaimer> vec(num_threads + 1);
 
       int each_thread = MAX_OPS / num_threads;
       int extra = MAX_OPS % num_threads;
@@ -324,12 +1072,86 @@ void test_all(int MAX_NUM_THREADS) {
   */
 }
 
-int main(void) {
+// The concurrent tests again over the storages that are never replaced.
+// Each gets a little more room than the tests grow to.
+template <typename Reclaimer>
+void test_storages(void) {
+  typedef waitfree::vector<int, Reclaimer, growth::doubling,
+                           waitfree::reserved_storage<1 << 17>>
+      reserved;
+  test_full<waitfree::vector<int, Reclaimer, growth::doubling,
+                             waitfree::reserved_storage<4096>>>("reserved");
+  test_shift<reserved>(9);
+  test_push_pop<reserved>(16);
+  test_grow<reserved>("reserved", 16, 5000);
+
+  typedef waitfree::vector<int, Reclaimer, growth::doubling,
+                           waitfree::segmented_storage<8>>
+      segmented;
+  test_shift<segmented>(9);
+  test_push_pop<segmented>(16);
+  test_grow<segmented>("segmented", 16, 5000);
+  test_read<segmented>(4, 4);
+
+  typedef waitfree::bounded_vector<int, 1 << 17, Reclaimer> bounded;
+  test_full<waitfree::bounded_vector<int, 1000, Reclaimer>>("bounded");
+  test_shift<bounded>(9);
+  test_push_pop<bounded>(16);
+  test_grow<bounded>("bounded", 16, 5000);
+  test_read<bounded>(4, 4);
+}
+
+template <typename Reclaimer>
+void test_reclaimer(void) {
+  test_range<Reclaimer>();
+  test_tid<Reclaimer>();
+  test_register<Reclaimer>(8);
+  test_push_range<Reclaimer>(8);
+  test_stats<Reclaimer>(8);
+  test_append_only<Reclaimer>(8);
+  test_reserve<waitfree::vector<int, Reclaimer>>("doubling");
+  // copies of up to 64 chunks of 1024 slots, shared between 16 threads
+  test_grow<waitfree::vector<int, Reclaimer>>("doubling", 16, 5000);
+  test_reserve<waitfree::vector<int, Reclaimer, growth::one_and_a_half>>(
+      "one_and_a_half");
+  test_grow<waitfree::vector<int, Reclaimer, growth::one_and_a_half>>(
+      "one_and_a_half", 8, 4000);
+  test_grow<waitfree::vector<int, Reclaimer, growth::fixed_chunk<700>>>(
+      "fixed_chunk", 8, 4000);
+  test_inline<Reclaimer>();
+  test_storages<Reclaimer>();
+  test_shift<waitfree::vector<int, Reclaimer>>(9);
+  test_push_pop<waitfree::vector<int, Reclaimer>>(16);
+  // helping checked for only once every few operations
+  test_shift<waitfree::vector<int, Reclaimer>>(9, 8);
+  test_push_pop<waitfree::vector<int, Reclaimer>>(16, 64);
+  // failed CASes in the fast paths pause for up to 256 spins
+  test_shift<waitfree::vector<int, Reclaimer>>(9, 1, 256);
+  test_push_pop<waitfree::vector<int, Reclaimer>>(16, 1, 256);
+  test_retry_limit<Reclaimer>();
+  test_read<waitfree::vector<int, Reclaimer>>(4, 4);
+  if (std::is_same<Reclaimer, waitfree::hazard_reclaimer>::value) {
+    test_stalled_reader();
+  }
+  test_all<Reclaimer>(32);
+}
+
+// usage: concurrent.out [epoch|hazard]
+int main(int argc, char** argv) {
+  const std::string reclaimer = argc > 1 ? argv[1] : "epoch";
+
   // test_pushback(16);
   // test_popback(16);
   // test_cwrite(16);
   // test_erase_insert(32);
-  test_all(32);
+  if (reclaimer == "epoch") {
+    test_reclaimer<waitfree::epoch_reclaimer>();
+  } else if (reclaimer == "hazard") {
+    test_reclaimer<waitfree::hazard_reclaimer>();
+  } else {
+    std::cerr << "unknown reclaimer " << reclaimer << "\n";
+    return 1;
+  }
 
   return 0;
 }
@@ -4,11 +4,13 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "../../common/growth.hpp"
+
 #include <strategy/lockablebase.h>
 #include <strategy/mrlockable.h>
 
 namespace blocking {
-  template <typename T>
+  template <typename T, typename Growth = growth::doubling>
   struct vector {
     // data stuff
     T** data;
@@ -55,7 +57,7 @@ namespace blocking {
 
     // this is called when capacity is implicitly increased
     void increase_cap(void) {
-      std::size_t new_cap = cap * 2 + 1;
+      std::size_t new_cap = Growth::grow(cap);
       resize(new_cap);
     }
 
@@ -169,6 +171,15 @@ namespace blocking {
       return cap;
     }
 
+    // grows the capacity to at least n in one step
+    void reserve(std::size_t n) {
+      my_lock->Lock();
+      if (n > cap) {
+        resize(n);
+      }
+      my_lock->Unlock();
+    }
+
     /********* end vector functions *********/
   };
 }; // namespace blocking
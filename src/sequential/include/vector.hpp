@@ -4,8 +4,10 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "../../common/growth.hpp"
+
 namespace sequential {
-  template <typename T>
+  template <typename T, typename Growth = growth::doubling>
   struct vector {
     // data stuff
     T** data;
@@ -43,7 +45,7 @@ namespace sequential {
 
     // this is called when capacity is implicitly increased
     void increase_cap(void) {
-      std::size_t new_cap = cap * 2 + 1;
+      std::size_t new_cap = Growth::grow(cap);
       resize(new_cap);
     }
 
@@ -133,6 +135,13 @@ namespace sequential {
       return cap;
     }
 
+    // grows the capacity to at least n in one step
+    void reserve(std::size_t n) {
+      if (n > cap) {
+        resize(n);
+      }
+    }
+
     /********* end vector functions *********/
   };
 }; // namespace sequential